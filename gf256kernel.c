@@ -0,0 +1,233 @@
+//
+//  gf256kernel.c
+//
+//  Log, exp and quadratic root tables for GF(256), and kernels for the
+//  inner loops of the encoder, the syndrome calculation and the root
+//  search. The kernels compute the same results in different ways:
+//
+//  gf256kernelTable   gf256mul, look-up in the 64 KB multiplication table
+//  gf256kernelLogExp  addition of logs and look-up in the exp table
+//  gf256kernelNibble  per constant 2 x 16 entry tables of c*x for the low
+//                     and high nibble of x, 16 symbols at a time with SSSE3
+//
+//  Which one is the fastest depends on the machine, see rs255tune.c.
+//
+
+#include "gf256.h"
+#include "rs255.h"
+#include "gf256kernel.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+static unsigned char gf256logaTable[256];
+static unsigned char gf256expaTable[256];
+static unsigned char gf256exp2Table[512];   /*a^(i mod 255), indexed by the sum of two logs*/
+static unsigned char gf256quadTable[256];
+
+/*Make the gf256.c tables, then log and exp tables with base rs255const_a and the table
+  of y so that y^2 + y = c. As a^255 = 1 the log of 1 is 255, as gf256loga returns it;
+  the log of 0 is also 255*/
+void initGF256kernelTables()
+{
+    long            i;
+    unsigned char   a, b, y;
+
+    initGF256tables();
+
+    a = rs255const_a;
+    b = 1;
+    gf256logaTable[0] = 255;
+    for (i=0; i<=255; i++) {
+        gf256logaTable[b] = (unsigned char) i;
+        gf256expaTable[i] = b;
+        b = gf256mul(b,a);
+    }
+    for (i=0; i<512; i++) {
+        gf256exp2Table[i] = gf256expaTable[i % 255];
+    }
+
+    for (i=0; i<=255; i++) {
+        gf256quadTable[i] = 0;
+    }
+    for (i=255; i>=0; i--) {
+        y = (unsigned char) i;
+        gf256quadTable[gf256mul(y,y) ^ y] = y;
+    }
+}
+
+/*Calculate log(x) with base rs255const_a using table look-up, same results as gf256loga*/
+unsigned char gf256kernelLoga(unsigned char x)
+{
+    return(gf256logaTable[x]);
+}
+
+/*Calculate exp(x) with base rs255const_a using table look-up, same results as gf256expa*/
+unsigned char gf256kernelExpa(unsigned char x)
+{
+    return(gf256expaTable[x]);
+}
+
+/*Solve y^2 + y = c using table look-up. Returns 0 if there is no solution (or c=0).
+  The other root is y+1*/
+unsigned char gf256quadRoot(unsigned char c)
+{
+    return(gf256quadTable[c]);
+}
+
+/*Make the nibble tables of c: lo[x] = c*x, hi[x] = c*(x*16)*/
+static void gf256nibbleTables(unsigned char c, unsigned char lo[], unsigned char hi[])
+{
+    long            i;
+
+    for (i=0; i<16; i++) {
+        lo[i] = gf256mul(c, (unsigned char) i);
+        hi[i] = gf256mul(c, (unsigned char) (i << 4));
+    }
+}
+
+/*Calculate dst[i] = dst[i] + c*src[i] for 0 <= i < n*/
+void gf256mulAddRegion(unsigned char dst[], unsigned char src[], unsigned char c, long n, long kernel)
+{
+    long            i, lc;
+    unsigned char   lo[16], hi[16];
+
+    if (c == 0) return;
+    switch(kernel) {
+        case gf256kernelLogExp : {
+            lc = gf256logaTable[c];
+            for (i=0; i<n; i++) {
+                if (src[i] != 0) dst[i] ^= gf256exp2Table[lc + gf256logaTable[src[i]]];
+            }
+            break;
+        }
+        case gf256kernelNibble : {
+            gf256nibbleTables(c, lo, hi);
+            i = 0;
+#if defined(__SSSE3__)
+            {
+                __m128i lo16, hi16, mask, x, y;
+
+                lo16 = _mm_loadu_si128((__m128i *) lo);
+                hi16 = _mm_loadu_si128((__m128i *) hi);
+                mask = _mm_set1_epi8(0x0f);
+                for (; (i+16)<=n; i+=16) {
+                    x = _mm_loadu_si128((__m128i *) (src+i));
+                    y = _mm_xor_si128(_mm_shuffle_epi8(lo16, _mm_and_si128(x, mask)),
+                                      _mm_shuffle_epi8(hi16, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+                    y = _mm_xor_si128(y, _mm_loadu_si128((__m128i *) (dst+i)));
+                    _mm_storeu_si128((__m128i *) (dst+i), y);
+                }
+            }
+#endif
+            for (; i<n; i++) {
+                dst[i] ^= lo[src[i] & 15] ^ hi[src[i] >> 4];
+            }
+            break;
+        }
+        default : {
+            for (i=0; i<n; i++) {
+                dst[i] ^= gf256mul(c, src[i]);
+            }
+            break;
+        }
+    }
+}
+
+/*Calculate b(x) = b[0] + b[1]*x + ... + b[n-1]*x^(n-1) using Horner's rule*/
+unsigned char gf256polyEval(unsigned char x, unsigned char b[], long n, long kernel)
+{
+    long            i, lx;
+    unsigned char   y;
+    unsigned char   lo[16], hi[16];
+
+    y = 0;
+    if (n <= 0) return(y);
+    if (x == 0) return(b[0]);
+    switch(kernel) {
+        case gf256kernelLogExp : {
+            lx = gf256logaTable[x];
+            for (i=(n-1); i>=0; i--) {
+                if (y != 0) y = gf256exp2Table[lx + gf256logaTable[y]];
+                y = y ^ b[i];
+            }
+            break;
+        }
+        case gf256kernelNibble : {
+            gf256nibbleTables(x, lo, hi);
+            for (i=(n-1); i>=0; i--) {
+                y = lo[y & 15] ^ hi[y >> 4] ^ b[i];
+            }
+            break;
+        }
+        default : {
+            for (i=(n-1); i>=0; i--) {
+                y = gf256mul(x, y) ^ b[i];
+            }
+            break;
+        }
+    }
+    return(y);
+}
+
+/*Find all x in GF(256) with p(x) = 0, p of degree d. The roots are returned in
+  roots[] and the return value is the number of roots found. Except for the table
+  kernel, which evaluates p in every x, this is a Chien search: p is evaluated in
+  x = a^t, t = 0..254, keeping the terms p[j]*a^(j*t) in registers*/
+long gf256roots(unsigned char p[], long d, unsigned char roots[], long kernel)
+{
+    long            i, j, t, count;
+    unsigned char   x, y;
+    long            lr[256];
+    unsigned char   r[256], lo[256][16], hi[256][16];
+
+    count = 0;
+    switch(kernel) {
+        case gf256kernelLogExp : {
+            if (p[0] == 0) roots[count++] = 0;
+            for (j=0; j<=d; j++) {
+                lr[j] = (p[j] == 0) ? -1 : (gf256logaTable[p[j]] % 255);
+            }
+            for (t=0; t<255; t++) {
+                y = 0;
+                for (j=0; j<=d; j++) {
+                    if (lr[j] < 0) continue;
+                    y = y ^ gf256expaTable[lr[j]];
+                    lr[j] = lr[j] + j;
+                    if (lr[j] >= 255) lr[j] = lr[j] - 255;
+                }
+                if (y == 0) roots[count++] = gf256expaTable[t];
+            }
+            break;
+        }
+        case gf256kernelNibble : {
+            if (p[0] == 0) roots[count++] = 0;
+            for (j=0; j<=d; j++) {
+                r[j] = p[j];
+                gf256nibbleTables(gf256expaTable[j % 255], lo[j], hi[j]);
+            }
+            for (t=0; t<255; t++) {
+                y = 0;
+                for (j=0; j<=d; j++) {
+                    y = y ^ r[j];
+                    r[j] = lo[j][r[j] & 15] ^ hi[j][r[j] >> 4];
+                }
+                if (y == 0) roots[count++] = gf256expaTable[t];
+            }
+            break;
+        }
+        default : {
+            for (i=0; i<=255; i++) {
+                x = (unsigned char) i;
+                y = 0;
+                for (j=d; j>=0; j--) {
+                    y = gf256mul(x, y) ^ p[j];
+                }
+                if (y == 0) roots[count++] = x;
+            }
+            break;
+        }
+    }
+    return(count);
+}
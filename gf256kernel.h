@@ -0,0 +1,20 @@
+//
+//  gf256kernel.h
+//
+//  Table based GF(256) helpers and interchangeable kernels for the inner
+//  loops of the RS255 encoder and decoder. gf256.c is left as distributed.
+//
+
+#define  gf256kernelTable   0 /*gf256mul, the 64 KB multiplication table*/
+#define  gf256kernelLogExp  1 /*log and exp tables*/
+#define  gf256kernelNibble  2 /*16 entry nibble tables, SSSE3 when available*/
+#define  gf256kernelCount   3
+
+void initGF256kernelTables();
+unsigned char gf256kernelLoga(unsigned char x);
+unsigned char gf256kernelExpa(unsigned char x);
+unsigned char gf256quadRoot(unsigned char c);
+
+void gf256mulAddRegion(unsigned char dst[], unsigned char src[], unsigned char c, long n, long kernel);
+unsigned char gf256polyEval(unsigned char x, unsigned char b[], long n, long kernel);
+long gf256roots(unsigned char p[], long d, unsigned char roots[], long kernel);
@@ -0,0 +1,233 @@
+//
+//  rs255adapt.c
+//
+//  Adaptive parity controller for rs255encode/rs255decode.
+//
+//  Every decoded codeword is recorded with rs255adaptRecord. From the last
+//  rs255adaptWindow results the controller estimates the channel's symbol
+//  error rate and symbol erasure rate, and from those the smallest parity
+//  count whose decoding failure probability stays below the target.
+//
+//  A codeword with e errors and u erasures is decoded when (2*e + u) <= k,
+//  k being the number of parity symbols. Errors and erasures are modelled
+//  as independent binomial events over the 255 symbols of a codeword. The
+//  rates are taken at their upper confidence bound, so a short clean window
+//  does not drop the parity count to the minimum.
+//
+
+#include <math.h>
+
+#include "rs255adapt.h"
+
+/*Binomial distribution of the number of hit symbols in a 255 symbol codeword. The
+  terms are built in log space, as q^255 underflows for p close to 1*/
+static void rs255binomial(double p, double pmf[])
+{
+    long            i;
+    double          lp, lq, term;
+
+    for (i=0; i<=255; i++) pmf[i] = 0.0;
+    if (p <= 0.0) {
+        pmf[0] = 1.0;
+        return;
+    }
+    if (p >= 1.0) {
+        pmf[255] = 1.0;
+        return;
+    }
+    lp = log(p);
+    lq = log1p(-p);
+    term = 255 * lq;
+    pmf[0] = exp(term);
+    for (i=0; i<255; i++) {
+        term = term + log((double) (255-i) / (double) (i+1)) + lp - lq;
+        pmf[i+1] = exp(term);
+    }
+}
+
+/*tailU[m] = P(u > m) for the erasure distribution pu[]*/
+static void rs255tail(double pu[], double tailU[])
+{
+    long            m;
+
+    tailU[255] = 0.0;
+    for (m=254; m>=0; m--) tailU[m] = tailU[m+1] + pu[m+1];
+}
+
+/*P(2*e + u > k) from the error distribution and the erasure tail. The tails are
+  summed directly so small probabilities keep their precision*/
+static double rs255failure(double pe[], double tailU[], long paritySymbols)
+{
+    long            e;
+    double          failure;
+
+    failure = 0.0;
+    for (e=0; e<=255; e++) {
+        if ((2*e) > paritySymbols) failure = failure + pe[e];
+        else if ((paritySymbols-2*e) < 255) failure = failure + pe[e] * tailU[paritySymbols-2*e];
+    }
+    return(failure);
+}
+
+/*Probability that a codeword with k parity symbols is not decodable, P(2*e + u > k)*/
+double rs255failureProbability(double errorRate, double erasureRate, long paritySymbols)
+{
+    double          pe[256], pu[256], tailU[256];
+
+    rs255binomial(errorRate, pe);
+    rs255binomial(erasureRate, pu);
+    rs255tail(pu, tailU);
+    return(rs255failure(pe, tailU, paritySymbols));
+}
+
+void rs255adaptInit(rs255adaptState *state, long paritySymbols, long minParity, long maxParity,
+                    double targetFailure, long autoSwitch)
+{
+    long            i;
+
+    if (minParity < 0) minParity = 0;
+    if (maxParity > 254) maxParity = 254;
+    if (maxParity < minParity) maxParity = minParity;
+    if (paritySymbols < minParity) paritySymbols = minParity;
+    if (paritySymbols > maxParity) paritySymbols = maxParity;
+
+    for (i=0; i<rs255adaptWindow; i++) {
+        state->corrected[i] = 0;
+        state->erasures[i] = 0;
+        state->parity[i] = 0;
+    }
+    state->count = 0;
+    state->next = 0;
+    state->sinceSwitch = 0;
+    state->paritySymbols = paritySymbols;
+    state->minParity = minParity;
+    state->maxParity = maxParity;
+    state->targetFailure = targetFailure;
+    state->autoSwitch = autoSwitch;
+}
+
+/*Count the error and erasure symbols over the window. A failed decode only tells
+  that (2*e + u) exceeded the parity count, so it is counted as the smallest number
+  of errors that makes the codeword undecodable, and at least one error when the
+  erasures alone exceeded the parity count.
+*/
+static void rs255adaptCount(rs255adaptState *state, long *errors, long *erasures)
+{
+    long            i, k;
+
+    *errors = 0;
+    *erasures = 0;
+    for (i=0; i<state->count; i++) {
+        k = state->parity[i];
+        *erasures = *erasures + state->erasures[i];
+        if (state->corrected[i] < 0) {
+            if (state->erasures[i] <= k) *errors = *errors + (k - state->erasures[i])/2 + 1;
+            else *errors = *errors + 1;
+        }
+        else if (state->corrected[i] > state->erasures[i]) {
+            *errors = *errors + state->corrected[i] - state->erasures[i];
+        }
+    }
+}
+
+/*Estimate the symbol error and erasure rates over the window*/
+void rs255adaptEstimate(rs255adaptState *state, double *errorRate, double *erasureRate)
+{
+    long            errors, erasures;
+
+    *errorRate = 0.0;
+    *erasureRate = 0.0;
+    if (state->count == 0) return;
+
+    rs255adaptCount(state, &errors, &erasures);
+    *errorRate = (double) errors / (255.0 * state->count);
+    *erasureRate = (double) erasures / (255.0 * state->count);
+}
+
+/*One-sided Wilson score upper bound of a rate with x hits in n trials at
+  rs255adaptConfidence. Close to the exact Clopper-Pearson bound for the counts of a
+  window (n = 255 per codeword), and cheap enough to run on every failed decode.
+*/
+static double rs255upperBound(long x, long n)
+{
+    double          p, z2, center, margin;
+
+    if (n <= 0) return(1.0);
+    if (x >= n) return(1.0);
+    p = (double) x / (double) n;
+    z2 = rs255adaptZ * rs255adaptZ;
+    center = p + z2 / (2.0 * n);
+    margin = rs255adaptZ * sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * (double) n));
+    return((center + margin) / (1.0 + z2 / n));
+}
+
+/*Upper confidence bounds of the symbol error and erasure rates over the window*/
+void rs255adaptBound(rs255adaptState *state, double *errorRate, double *erasureRate)
+{
+    long            errors, erasures;
+
+    rs255adaptCount(state, &errors, &erasures);
+    *errorRate = rs255upperBound(errors, 255 * state->count);
+    *erasureRate = rs255upperBound(erasures, 255 * state->count);
+}
+
+/*Smallest parity count in [minParity, maxParity] meeting the target failure probability.
+  The rates are taken at their upper confidence bound, as a window of codewords is far
+  too small to observe failure probabilities near the target directly. The failure
+  probability falls with the parity count, so the count is found by bisection.
+*/
+long rs255adaptRecommend(rs255adaptState *state)
+{
+    long            low, high, k;
+    double          errorRate, erasureRate;
+    double          pe[256], pu[256], tailU[256];
+
+    if (state->count == 0) return(state->paritySymbols);
+    rs255adaptBound(state, &errorRate, &erasureRate);
+    rs255binomial(errorRate, pe);
+    rs255binomial(erasureRate, pu);
+    rs255tail(pu, tailU);
+    low = state->minParity;
+    high = state->maxParity;
+    while (low < high) {
+        k = (low + high) / 2;
+        if (rs255failure(pe, tailU, k) <= state->targetFailure) high = k;
+        else low = k + 1;
+    }
+    return(low);
+}
+
+/*Record the outcome of one rs255decode call. With autoSwitch set the parity count is
+  re-evaluated after a failed decode and otherwise once per full window of results.
+  A failed decode always raises the parity count above the one that failed.
+*/
+void rs255adaptRecord(rs255adaptState *state, long decodeResult, long erasureCount, long paritySymbols)
+{
+    long            k;
+
+    state->corrected[state->next] = decodeResult;
+    state->erasures[state->next] = erasureCount;
+    state->parity[state->next] = paritySymbols;
+    state->next = (state->next + 1) % rs255adaptWindow;
+    if (state->count < rs255adaptWindow) state->count = state->count + 1;
+    state->sinceSwitch = state->sinceSwitch + 1;
+
+    if (state->autoSwitch == 0) return;
+    if ((decodeResult >= 0) && (state->sinceSwitch < rs255adaptWindow)) return;
+
+    k = rs255adaptRecommend(state);
+    if ((decodeResult < 0) && (k <= paritySymbols)) k = paritySymbols + 1;
+    if (k > state->maxParity) k = state->maxParity;
+    if (k != state->paritySymbols) {
+        state->paritySymbols = k;
+        state->sinceSwitch = 0;
+    }
+    else if (state->sinceSwitch >= rs255adaptWindow) {
+        state->sinceSwitch = 0;
+    }
+}
+
+long rs255adaptParity(rs255adaptState *state)
+{
+    return(state->paritySymbols);
+}
@@ -0,0 +1,32 @@
+//
+//  rs255adapt.h
+//
+//  Adaptive parity controller. Feeds on rs255decode results and picks the
+//  parity symbol count for new codewords.
+//
+
+#define  rs255adaptWindow      64   /*number of decode results kept in the sliding window*/
+#define  rs255adaptConfidence  0.95 /*confidence of the upper bound on the channel rates*/
+#define  rs255adaptZ           1.645 /*one-sided normal quantile of rs255adaptConfidence*/
+
+typedef struct {
+    long    corrected[rs255adaptWindow]; /*rs255decode return value, -1 if decoding failed*/
+    long    erasures[rs255adaptWindow];  /*erasures flagged in u[] for the codeword*/
+    long    parity[rs255adaptWindow];    /*parity symbols the codeword was encoded with*/
+    long    count;                       /*valid entries in the window*/
+    long    next;                        /*window slot written by the next record*/
+    long    sinceSwitch;                 /*records since the parity count last changed*/
+    long    paritySymbols;               /*parity count to use for new codewords*/
+    long    minParity, maxParity;
+    double  targetFailure;               /*acceptable decoding failure probability per codeword*/
+    long    autoSwitch;                  /*non-zero: apply the recommendation automatically*/
+} rs255adaptState;
+
+void   rs255adaptInit(rs255adaptState *state, long paritySymbols, long minParity, long maxParity,
+                      double targetFailure, long autoSwitch);
+void   rs255adaptRecord(rs255adaptState *state, long decodeResult, long erasureCount, long paritySymbols);
+void   rs255adaptEstimate(rs255adaptState *state, double *errorRate, double *erasureRate);
+void   rs255adaptBound(rs255adaptState *state, double *errorRate, double *erasureRate);
+long   rs255adaptRecommend(rs255adaptState *state);
+long   rs255adaptParity(rs255adaptState *state);
+double rs255failureProbability(double errorRate, double erasureRate, long paritySymbols);
@@ -0,0 +1,207 @@
+//
+//  rs255fast.c
+//
+//  RS255 encoder and decoder built from the stages in rs255.c, with the
+//  inner loops of encoding, syndrome calculation and root search done by
+//  the gf256kernel kernel selected for the operation and parity count, and
+//  with a closed form decoder for the common case of one or two errors.
+//  The table kernel is used until rs255selectKernel or rs255tune choose
+//  another one. initGF256kernelTables() must be called first.
+//
+
+#include "gf256.h"
+#include "rs255.h"
+#include "gf256kernel.h"
+#include "rs255fast.h"
+
+static unsigned char rs255kernel[rs255opCount][256]; /*gf256 kernel per operation and parity count*/
+
+/*Select the gf256 kernel used by an operation for parity counts low..high. For
+  rs255opRoots the range is over the degree of the error locator polynomial*/
+void rs255selectKernel(long operation, long low, long high, long kernel)
+{
+    long            i;
+
+    if ((operation < 0) || (operation >= rs255opCount)) return;
+    if ((kernel < 0) || (kernel >= gf256kernelCount)) return;
+    if (low < 0) low = 0;
+    if (high > 255) high = 255;
+    for (i=low; i<=high; i++) {
+        rs255kernel[operation][i] = (unsigned char) kernel;
+    }
+}
+
+long rs255kernelFor(long operation, long n)
+{
+    if ((operation < 0) || (operation >= rs255opCount) || (n < 0) || (n > 255)) return(gf256kernelTable);
+    return(rs255kernel[operation][n]);
+}
+
+/*Same as rs255encode*/
+void rs255fastEncode(unsigned char b[], long n)
+{
+    long            i;
+    unsigned char   a, g[256], p[256];
+
+    makeRS255generator(g, n);
+    for (i=(254-n); i>=0; i--) {
+        p[i+n] = b[i];
+        b[i+n] = b[i];
+    }
+    for (i=(n-1); i>=0; i--) {
+        p[i] = 0;
+    }
+    for (i=254; i>=n; i--) {
+        a = p[i];
+        gf256mulAddRegion(&p[i-n], g, a, n+1, rs255kernel[rs255opEncode][n]);
+    }
+    for (i=(n-1); i>=0; i--) {
+        b[i] = p[i];
+    }
+}
+
+/*Same as rs255syndroms*/
+void rs255fastSyndroms(unsigned char b[], unsigned char s[], long n)
+{
+    long            i;
+    unsigned char   x, a;
+
+    a = rs255const_a;
+    x = rs255const_a111;
+    for (i=0; i<n; i++) {
+        x = gf256mul(x,a);
+        s[i] = gf256polyEval(x, b, 255, rs255kernel[rs255opSyndroms][n]);
+    }
+}
+
+/* Closed form decoding of one or two errors when there are no erasures.
+   The syndromes are s[i] = Y1*X1^i + Y2*X2^i with Xj = a^position and
+   Yj = value*a^(112*position). One error: X1 = s[1]/s[0] and all syndromes
+   form a geometric series. Two errors: X1 and X2 are the roots of
+   x^2 + sigma1*x + sigma2 where s[i+2] = sigma1*s[i+1] + sigma2*s[i], found
+   by solving y^2 + y = sigma2/sigma1^2 with x = sigma1*y. The return value is
+   the number of errors found, -1 if the syndromes do not fit 0, 1 or 2 errors
+*/
+long rs255fastErrors(unsigned char s[],        //syndromes
+                     unsigned char position[], //error positions
+                     unsigned char value[],    //error value
+                     long n)                   //number of syndromes
+{
+    long            i, p1, p2;
+    unsigned char   x1, x2, y1, y2, d, sigma1, sigma2;
+
+    i = 0;
+    while ((i<n) && (s[i]==0)) i = i+1;
+    if (i==n) return(0);
+    if (n<2) return(-1);
+
+    if ((s[0]!=0) && (s[1]!=0)) {
+        x1 = gf256mul(s[1], gf256inv(s[0]));
+        i = 1;
+        while (((i+1)<n) && (s[i+1]==gf256mul(s[i],x1))) i = i+1;
+        if ((i+1)==n) {
+            p1 = gf256kernelLoga(x1) % 255;
+            position[0] = (unsigned char) p1;
+            value[0] = gf256mul(s[0], gf256inv(gf256kernelExpa((unsigned char) ((112*p1) % 255))));
+            return(1);
+        }
+    }
+    if (n<4) return(-1);
+
+    d = gf256mul(s[1],s[1]) ^ gf256mul(s[0],s[2]);
+    if (d==0) return(-1);
+    d = gf256inv(d);
+    sigma1 = gf256mul(gf256mul(s[2],s[1]) ^ gf256mul(s[0],s[3]), d);
+    sigma2 = gf256mul(gf256mul(s[1],s[3]) ^ gf256mul(s[2],s[2]), d);
+    if ((sigma1==0) || (sigma2==0)) return(-1);
+    for (i=2; (i+2)<n; i++) {
+        if (s[i+2] != (gf256mul(sigma1,s[i+1]) ^ gf256mul(sigma2,s[i]))) return(-1);
+    }
+
+    y1 = gf256quadRoot(gf256mul(sigma2, gf256inv(gf256mul(sigma1,sigma1))));
+    if (y1==0) return(-1);
+    x1 = gf256mul(sigma1,y1);
+    x2 = x1 ^ sigma1;
+    y1 = gf256mul(s[1] ^ gf256mul(s[0],x2), gf256inv(sigma1));
+    y2 = s[0] ^ y1;
+    if ((y1==0) || (y2==0)) return(-1);
+
+    p1 = gf256kernelLoga(x1) % 255;
+    p2 = gf256kernelLoga(x2) % 255;
+    position[0] = (unsigned char) p1;
+    position[1] = (unsigned char) p2;
+    value[0] = gf256mul(y1, gf256inv(gf256kernelExpa((unsigned char) ((112*p1) % 255))));
+    value[1] = gf256mul(y2, gf256inv(gf256kernelExpa((unsigned char) ((112*p2) % 255))));
+    return(2);
+}
+
+/* Same as rs255errors, with the root search done by gf256roots. Returns the
+   number of roots found in sigma if it is equal to the degree of sigma,
+   otherwise -1
+*/
+long rs255fastRoots(unsigned char sigma[],    //error locator poly
+                    unsigned char omega[],    //error value poly
+                    unsigned char position[], //error positions
+                    unsigned char value[],    //error value
+                    long maxDegree)           //max sigma degree
+{
+    long            i, sigmaDegree, deltaSigmaDegree, rootCount;
+    unsigned char   x, y1, y2, y3;
+    unsigned char   deltaSigma[256], roots[256];
+
+    sigmaDegree = maxDegree;
+    while ((sigma[sigmaDegree]==0) && (sigmaDegree>0)) sigmaDegree = sigmaDegree - 1;
+
+    i = 0;
+    while ((2*i+1)<=sigmaDegree) {
+        deltaSigma[i] = sigma[2*i+1];
+        i = i+1;
+    }
+    deltaSigmaDegree = i-1;
+
+    rootCount = gf256roots(sigma, sigmaDegree, roots, rs255kernel[rs255opRoots][sigmaDegree]);
+    if (rootCount != sigmaDegree) return(-1);
+    for (i=0; i<rootCount; i++) {
+        x = roots[i];
+        position[i] = 255-gf256kernelLoga(x);
+        y1 = polyEval(gf256mul(x,x),deltaSigma,deltaSigmaDegree+1);
+        y2 = polyEval(x,omega,maxDegree);
+        y3 = gf256x111(x);
+        value[i] = gf256mul(y3,gf256mul(y2,gf256inv(y1)));
+    }
+    return(rootCount);
+}
+
+/* Same as rs255decode. Without erasures one or two errors are corrected by
+   rs255fastErrors; anything else goes through Euclid and the root search.
+   rs255euclid reads before the start of its remainder when the syndromes are all
+   zero, so that case returns at once, as does a codeword with more erasures than
+   parity symbols. The erasure syndrome product has up to 2*254 coefficients.
+*/
+long rs255fastDecode(unsigned char r[], unsigned char u[], unsigned char c[], long syndromeCount)
+{
+    long            i, erasureCount, errorCount, errorEraseCount;
+    unsigned char   errorSigma[256], erasureSigma[256], erasureSyndrome[512];
+    unsigned char   syndrome[256], omega[256], sigma[256], ePos[256], eVal[256];
+
+    for (i=0; i<255; i++) c[i] = r[i];
+    erasureCount = rs255erasure(u, erasureSigma);
+    if (erasureCount > syndromeCount) return(-1);
+    rs255fastSyndroms(r, syndrome, syndromeCount);
+    i = 0;
+    while ((i<syndromeCount) && (syndrome[i]==0)) i = i+1;
+    if (i==syndromeCount) return(erasureCount);
+    errorEraseCount = -1;
+    if (erasureCount == 0) errorEraseCount = rs255fastErrors(syndrome, ePos, eVal, syndromeCount);
+    if (errorEraseCount < 0) {
+        polyMultiply(erasureSigma, syndrome, erasureSyndrome, erasureCount, syndromeCount);
+        errorCount = rs255euclid(erasureSyndrome, omega, errorSigma, syndromeCount, erasureCount);
+        polyMultiply(erasureSigma, errorSigma, sigma, erasureCount, errorCount);
+        errorEraseCount = rs255fastRoots(sigma, omega, ePos, eVal, (errorCount+erasureCount));
+    }
+
+    for (i=0; i<errorEraseCount; i++) {
+        c[ePos[i]] = r[ePos[i]] ^ eVal[i];
+    }
+    return(errorEraseCount);
+}
@@ -0,0 +1,33 @@
+//
+//  rs255fast.h
+//
+//  RS255 encoder and decoder using the gf256kernel kernels selected per
+//  operation and parity count, and a closed form decoder for one or two
+//  errors. Same codewords and results as rs255encode/rs255decode, which
+//  are left as distributed.
+//
+
+#define  rs255opEncode    0
+#define  rs255opSyndroms  1
+#define  rs255opRoots     2 /*root search of the error locator polynomial*/
+#define  rs255opCount     3
+
+void rs255selectKernel(long operation, long low, long high, long kernel);
+long rs255kernelFor(long operation, long n);
+
+void rs255fastEncode(unsigned char b[], long n);
+void rs255fastSyndroms(unsigned char b[], unsigned char s[], long n);
+long rs255fastErrors(unsigned char s[], unsigned char position[], unsigned char value[], long n);
+long rs255fastRoots(unsigned char sigma[], unsigned char omega[], unsigned char position[], unsigned char value[],
+                    long maxDegree);
+long rs255fastDecode(unsigned char r[], unsigned char u[], unsigned char c[], long syndromeCount);
+
+/*Stages of the decoder in rs255.c, in the order rs255decode calls them*/
+unsigned char polyEval(unsigned char a, unsigned char b[], long n);
+void makeRS255generator(unsigned char b[], long n);
+long rs255erasure(unsigned char u[], unsigned char s[]);
+void rs255syndroms(unsigned char b[], unsigned char s[], long n);
+long polyMultiply(unsigned char p1[], unsigned char p2[], unsigned char p3[], long p1deg, long p2deg);
+long rs255euclid(unsigned char b[], unsigned char r[], unsigned char t[], long n, long k);
+long rs255errors(unsigned char sigma[], unsigned char omega[], unsigned char position[], unsigned char value[],
+                 long maxDegree);
@@ -0,0 +1,145 @@
+//
+//  rs255perf.c
+//
+//  Hardware performance counters for the benchmark mode in test.c. The
+//  counters are opened as one group with cycles as the leader, so they are
+//  always scheduled together. If the PMU has fewer free counters than the
+//  group needs, the kernel multiplexes the whole group; the counts are then
+//  scaled by time enabled / time running, and a group that never ran reads
+//  as unavailable. A counter the CPU, the kernel or a virtual machine does
+//  not provide is left out of the group. Only user space is counted. On
+//  other systems than Linux no counter is available.
+//
+
+#define _GNU_SOURCE
+
+#include <string.h>
+
+#include "rs255perf.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char *rs255perfName[rs255perfCounters] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses"
+};
+
+#if defined(__linux__)
+static int rs255perfEvent(unsigned int type, unsigned long long config, int leader)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = (leader < 0) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return((int) syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+}
+#endif
+
+/*Open the counters for the calling thread. Returns the number of counters available*/
+long rs255perfOpen(rs255perfState *perf)
+{
+    long            i;
+#if defined(__linux__)
+    unsigned int    type[rs255perfCounters];
+    unsigned long long config[rs255perfCounters];
+#endif
+
+    for (i=0; i<rs255perfCounters; i++) {
+        perf->fd[i] = -1;
+        perf->count[i] = 0;
+    }
+    perf->leader = -1;
+    perf->members = 0;
+    perf->enabled = 0;
+    perf->running = 0;
+#if defined(__linux__)
+    type[rs255perfCycles] = PERF_TYPE_HARDWARE;
+    config[rs255perfCycles] = PERF_COUNT_HW_CPU_CYCLES;
+    type[rs255perfInstructions] = PERF_TYPE_HARDWARE;
+    config[rs255perfInstructions] = PERF_COUNT_HW_INSTRUCTIONS;
+    type[rs255perfL1DMisses] = PERF_TYPE_HW_CACHE;
+    config[rs255perfL1DMisses] = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    type[rs255perfLLCMisses] = PERF_TYPE_HARDWARE;
+    config[rs255perfLLCMisses] = PERF_COUNT_HW_CACHE_MISSES;
+    type[rs255perfBranchMisses] = PERF_TYPE_HARDWARE;
+    config[rs255perfBranchMisses] = PERF_COUNT_HW_BRANCH_MISSES;
+
+    for (i=0; i<rs255perfCounters; i++) {
+        perf->fd[i] = rs255perfEvent(type[i], config[i], perf->leader);
+        if (perf->fd[i] < 0) continue;
+        if (perf->leader < 0) perf->leader = perf->fd[i];
+        perf->order[perf->members] = i;
+        perf->members++;
+    }
+#endif
+    return(perf->members);
+}
+
+void rs255perfStart(rs255perfState *perf)
+{
+    long            i;
+
+    for (i=0; i<rs255perfCounters; i++) perf->count[i] = 0;
+    perf->enabled = 0;
+    perf->running = 0;
+#if defined(__linux__)
+    if (perf->leader < 0) return;
+    ioctl(perf->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+/*Stop counting and read the counts since rs255perfStart into perf->count[]. When the
+  group was multiplexed the counts are scaled up to the time it was enabled*/
+void rs255perfStop(rs255perfState *perf)
+{
+#if defined(__linux__)
+    long                i;
+    unsigned long long  buffer[3+rs255perfCounters];
+    double              scale;
+
+    if (perf->leader < 0) return;
+    ioctl(perf->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(perf->leader, buffer, sizeof(buffer)) < (long) (3*sizeof(buffer[0]))) return;
+    if (buffer[0] != (unsigned long long) perf->members) return;
+    perf->enabled = buffer[1];
+    perf->running = buffer[2];
+    if (perf->running == 0) return;
+    scale = (double) perf->enabled / (double) perf->running;
+    for (i=0; i<perf->members; i++) {
+        perf->count[perf->order[i]] = (unsigned long long) (scale * (double) buffer[3+i]);
+    }
+#endif
+}
+
+/*Non-zero if the counter was open and the group actually counted in the last
+  measurement*/
+long rs255perfValid(rs255perfState *perf, long counter)
+{
+    return((perf->fd[counter] >= 0) && (perf->running > 0));
+}
+
+void rs255perfClose(rs255perfState *perf)
+{
+    long            i;
+
+    for (i=rs255perfCounters-1; i>=0; i--) {
+#if defined(__linux__)
+        if (perf->fd[i] >= 0) close(perf->fd[i]);
+#endif
+        perf->fd[i] = -1;
+    }
+    perf->leader = -1;
+    perf->members = 0;
+}
@@ -0,0 +1,30 @@
+//
+//  rs255perf.h
+//
+//  Hardware performance counters (Linux perf_event_open) for measuring the
+//  codec stages.
+//
+
+#define  rs255perfCycles        0
+#define  rs255perfInstructions  1
+#define  rs255perfL1DMisses     2 /*L1 data cache read misses*/
+#define  rs255perfLLCMisses     3 /*last level cache misses*/
+#define  rs255perfBranchMisses  4
+#define  rs255perfCounters      5
+
+typedef struct {
+    int                 fd[rs255perfCounters];    /*-1 if the counter is not available*/
+    int                 leader;                   /*group leader fd, -1 if no counter is available*/
+    long                order[rs255perfCounters]; /*counters in the order they joined the group*/
+    long                members;
+    unsigned long long  count[rs255perfCounters]; /*scaled to the enabled time if multiplexed*/
+    unsigned long long  enabled, running;         /*time the group was enabled and counting*/
+} rs255perfState;
+
+extern const char *rs255perfName[rs255perfCounters];
+
+long rs255perfOpen(rs255perfState *perf);
+void rs255perfStart(rs255perfState *perf);
+void rs255perfStop(rs255perfState *perf);
+long rs255perfValid(rs255perfState *perf, long counter);
+void rs255perfClose(rs255perfState *perf);
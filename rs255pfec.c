@@ -0,0 +1,293 @@
+//
+//  rs255pfec.c
+//
+//  Packet level forward error correction for real-time streams.
+//
+//  A window holds k data packets followed by m parity packets. Byte c of
+//  every packet in the window is one shortened RS255 codeword with m parity
+//  symbols: parity packet p is codeword position p and data packet i is
+//  position m+i. Data packets are prefixed with their 2 byte length inside
+//  the codeword, so a recovered packet also gets its length back.
+//
+//  The encoder emits each data packet at once and the m parity packets as
+//  soon as the window is full, so the added latency is fixed by k. The
+//  decoder hands data packets on as they arrive. Lost packets are marked
+//  as erasures in u[] and recovered by rs255fastDecode as soon as any k of the
+//  k+m packets of the window are in.
+//
+//  initGF256kernelTables() must be called before any of these functions.
+//
+
+#include <string.h>
+
+#include "rs255fast.h"
+#include "rs255pfec.h"
+
+long rs255pfecEncoderInit(rs255pfecEncoder *encoder, long k, long m)
+{
+    if ((k < 1) || (m < 1) || ((k+m) > rs255pfecMaxPackets)) return(-1);
+    encoder->k = k;
+    encoder->m = m;
+    encoder->window = 0;
+    encoder->count = 0;
+    encoder->symbols = 0;
+    return(0);
+}
+
+/*Calculate the parity packets of the current window and start the next one*/
+static long rs255pfecParity(rs255pfecEncoder *encoder, rs255pfecPacket out[])
+{
+    long            i, c, p, m;
+    unsigned char   b[256];
+
+    m = encoder->m;
+    for (c=0; c<encoder->symbols; c++) {
+        for (i=0; i<encoder->count; i++) b[i] = encoder->data[i][c];
+        for (i=encoder->count; i<255; i++) b[i] = 0;
+        rs255fastEncode(b, m);
+        for (p=0; p<m; p++) out[p].data[c] = b[p];
+    }
+    for (p=0; p<m; p++) {
+        out[p].window = encoder->window;
+        out[p].index = encoder->k + p;
+        out[p].dataCount = encoder->count;
+        out[p].length = encoder->symbols;
+    }
+    encoder->window = encoder->window + 1;
+    encoder->count = 0;
+    encoder->symbols = 0;
+    return(m);
+}
+
+/*Add one payload to the current window. out[] must have room for 1+m packets; the
+  data packet is returned in out[0], followed by the parity packets when the window
+  is full. Returns the number of packets to send, -1 if the payload is too long.
+*/
+long rs255pfecEncode(rs255pfecEncoder *encoder, unsigned char payload[], long length, rs255pfecPacket out[])
+{
+    unsigned char   *row;
+
+    if ((length < 0) || (length > rs255pfecMaxPayload)) return(-1);
+
+    row = encoder->data[encoder->count];
+    row[0] = (unsigned char) (length >> 8);
+    row[1] = (unsigned char) length;
+    memcpy(row+2, payload, length);
+    memset(row+2+length, 0, rs255pfecSymbols-2-length);
+
+    out[0].window = encoder->window;
+    out[0].index = encoder->count;
+    out[0].dataCount = encoder->k;
+    out[0].length = length;
+    memcpy(out[0].data, payload, length);
+
+    encoder->count = encoder->count + 1;
+    if ((length+2) > encoder->symbols) encoder->symbols = length+2;
+    if (encoder->count < encoder->k) return(1);
+    return(1 + rs255pfecParity(encoder, out+1));
+}
+
+/*Close a partly filled window, e.g. when the stream pauses. Returns the number of
+  parity packets written to out[].
+*/
+long rs255pfecEncoderFlush(rs255pfecEncoder *encoder, rs255pfecPacket out[])
+{
+    if (encoder->count == 0) return(0);
+    return(rs255pfecParity(encoder, out));
+}
+
+long rs255pfecDecoderInit(rs255pfecDecoder *decoder, long k, long m, rs255pfecDeliver deliver, void *context)
+{
+    long            i;
+
+    if ((k < 1) || (m < 1) || ((k+m) > rs255pfecMaxPackets)) return(-1);
+    decoder->k = k;
+    decoder->m = m;
+    decoder->deliver = deliver;
+    decoder->context = context;
+    for (i=0; i<rs255pfecWindowSlots; i++) {
+        decoder->slot[i].window = 0;
+        decoder->slot[i].active = 0;
+        decoder->slot[i].expired = 0;
+    }
+    return(0);
+}
+
+static void rs255pfecOpen(rs255pfecDecoder *decoder, rs255pfecWindow *w, unsigned long window)
+{
+    long            i;
+
+    w->window = window;
+    w->active = 1;
+    w->expired = 0;
+    w->complete = 0;
+    w->dataCount = decoder->k;
+    w->symbols = 0;
+    for (i=0; i<rs255pfecMaxPackets; i++) {
+        w->present[i] = 0;
+        w->delivered[i] = 0;
+    }
+}
+
+/*Recover the missing data packets of a window once enough packets are in. Returns
+  the number of packets delivered.
+*/
+static long rs255pfecRecover(rs255pfecDecoder *decoder, rs255pfecWindow *w)
+{
+    long            i, c, m, k, received, missing, length, delivered;
+    unsigned char   r[256], u[256], cw[256];
+
+    m = decoder->m;
+    k = w->dataCount;
+    received = 0;
+    missing = 0;
+    for (i=0; i<k; i++) {
+        if (w->present[i]) received++;
+        else missing++;
+    }
+    if (missing == 0) {
+        w->complete = 1;
+        return(0);
+    }
+    for (i=0; i<m; i++) {
+        if (w->present[decoder->k+i]) received++;
+    }
+    if ((w->symbols == 0) || (received < k)) return(0);
+
+    for (i=0; i<255; i++) {
+        r[i] = 0;
+        u[i] = 0;
+    }
+    for (i=0; i<m; i++) u[i] = !w->present[decoder->k+i];
+    for (i=0; i<k; i++) u[m+i] = !w->present[i];
+
+    for (c=0; c<w->symbols; c++) {
+        for (i=0; i<m; i++) r[i] = u[i] ? 0 : w->data[decoder->k+i][c];
+        for (i=0; i<k; i++) r[m+i] = u[m+i] ? 0 : w->data[i][c];
+        if (rs255fastDecode(r, u, cw, m) < 0) return(0);
+        for (i=0; i<k; i++) {
+            if (u[m+i]) w->data[i][c] = cw[m+i];
+        }
+    }
+
+    delivered = 0;
+    for (i=0; i<k; i++) {
+        if (w->delivered[i]) continue;
+        length = (w->data[i][0] << 8) | w->data[i][1];
+        if (length > rs255pfecMaxPayload) continue;
+        w->present[i] = 1;
+        w->delivered[i] = 1;
+        decoder->deliver(decoder->context, w->window, i, w->data[i]+2, length);
+        delivered++;
+    }
+    w->complete = 1;
+    return(delivered);
+}
+
+/*Feed one received packet to the decoder. Data packets are delivered at once, lost
+  ones as soon as the window can be recovered. Returns the number of packets
+  delivered, -1 if the packet is malformed.
+*/
+long rs255pfecDecoderReceive(rs255pfecDecoder *decoder, rs255pfecPacket *packet)
+{
+    long            index, length, delivered;
+    rs255pfecWindow *w;
+    unsigned char   *row;
+
+    index = packet->index;
+    length = packet->length;
+    if ((index < 0) || (index >= (decoder->k + decoder->m))) return(-1);
+    if ((length < 0) || (length > rs255pfecSymbols)) return(-1);
+    if ((index < decoder->k) && (length > rs255pfecMaxPayload)) return(-1);
+
+    w = &decoder->slot[packet->window % rs255pfecWindowSlots];
+    if ((w->active == 0) || (w->window != packet->window)) {
+        if ((w->active != 0) && (packet->window < w->window)) return(0);
+        if ((w->expired != 0) && (packet->window <= w->window)) return(0);
+        rs255pfecOpen(decoder, w, packet->window);
+    }
+    if ((w->complete != 0) || (w->present[index] != 0)) return(0);
+
+    row = w->data[index];
+    delivered = 0;
+    if (index < decoder->k) {
+        row[0] = (unsigned char) (length >> 8);
+        row[1] = (unsigned char) length;
+        memcpy(row+2, packet->data, length);
+        memset(row+2+length, 0, rs255pfecSymbols-2-length);
+        w->present[index] = 1;
+        if (index < w->dataCount) {
+            w->delivered[index] = 1;
+            decoder->deliver(decoder->context, w->window, index, row+2, length);
+            delivered = 1;
+        }
+    }
+    else {
+        if ((packet->dataCount < 1) || (packet->dataCount > decoder->k)) return(-1);
+        memcpy(row, packet->data, length);
+        w->present[index] = 1;
+        w->symbols = length;
+        w->dataCount = packet->dataCount;
+    }
+    return(delivered + rs255pfecRecover(decoder, w));
+}
+
+/*Give up on a window whose deadline has passed. Packets of it that arrive later are
+  dropped. Returns the number of data packets that were never delivered.
+*/
+long rs255pfecDecoderExpire(rs255pfecDecoder *decoder, unsigned long window)
+{
+    long            i, lost;
+    rs255pfecWindow *w;
+
+    w = &decoder->slot[window % rs255pfecWindowSlots];
+    if ((w->active == 0) || (w->window != window)) return(0);
+    lost = 0;
+    for (i=0; i<w->dataCount; i++) {
+        if (w->delivered[i] == 0) lost++;
+    }
+    w->active = 0;
+    w->expired = 1;
+    return(lost);
+}
+
+void rs255pfecRingInit(rs255pfecRing *ring)
+{
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+static void rs255pfecCopy(rs255pfecPacket *to, rs255pfecPacket *from)
+{
+    to->window = from->window;
+    to->index = from->index;
+    to->dataCount = from->dataCount;
+    to->length = from->length;
+    memcpy(to->data, from->data, from->length);
+}
+
+/*Called from the producer thread only. Returns 0 if the ring is full*/
+long rs255pfecRingPush(rs255pfecRing *ring, rs255pfecPacket *packet)
+{
+    unsigned long   head, tail;
+
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if ((head - tail) == rs255pfecRingSize) return(0);
+    rs255pfecCopy(&ring->packet[head & (rs255pfecRingSize-1)], packet);
+    atomic_store_explicit(&ring->head, head+1, memory_order_release);
+    return(1);
+}
+
+/*Called from the consumer thread only. Returns 0 if the ring is empty*/
+long rs255pfecRingPop(rs255pfecRing *ring, rs255pfecPacket *packet)
+{
+    unsigned long   head, tail;
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) return(0);
+    rs255pfecCopy(packet, &ring->packet[tail & (rs255pfecRingSize-1)]);
+    atomic_store_explicit(&ring->tail, tail+1, memory_order_release);
+    return(1);
+}
@@ -0,0 +1,72 @@
+//
+//  rs255pfec.h
+//
+//  Packet level forward error correction on top of rs255encode/rs255decode.
+//  Column c of a window of packets forms one RS255 codeword, so every lost
+//  packet is one erasure in each column.
+//
+
+#include <stdatomic.h>
+
+#define  rs255pfecMaxPackets   64    /*max data + parity packets in a window*/
+#define  rs255pfecMaxPayload   1400  /*max payload bytes in a data packet*/
+#define  rs255pfecSymbols      (rs255pfecMaxPayload + 2) /*2 length bytes + payload*/
+#define  rs255pfecWindowSlots  4     /*windows the decoder keeps open at the same time*/
+#define  rs255pfecRingSize     256   /*packets in the ring, must be a power of 2*/
+
+typedef struct {
+    unsigned long   window;     /*window sequence number*/
+    long            index;      /*0..k-1 data packets, k..k+m-1 parity packets*/
+    long            dataCount;  /*data packets in the window, set in parity packets*/
+    long            length;     /*bytes used in data[]*/
+    unsigned char   data[rs255pfecSymbols];
+} rs255pfecPacket;
+
+typedef struct {
+    long            k, m;       /*data and parity packets per window*/
+    unsigned long   window;
+    long            count;      /*data packets in the current window*/
+    long            symbols;    /*longest column count in the current window*/
+    unsigned char   data[rs255pfecMaxPackets][rs255pfecSymbols];
+} rs255pfecEncoder;
+
+typedef struct {
+    unsigned long   window;
+    long            active;
+    long            expired;    /*window was given up, its late packets are dropped*/
+    long            complete;   /*all data packets delivered*/
+    long            dataCount;
+    long            symbols;    /*column count, known once a parity packet arrived*/
+    unsigned char   present[rs255pfecMaxPackets];
+    unsigned char   delivered[rs255pfecMaxPackets];
+    unsigned char   data[rs255pfecMaxPackets][rs255pfecSymbols];
+} rs255pfecWindow;
+
+typedef void (*rs255pfecDeliver)(void *context, unsigned long window, long index,
+                                 unsigned char payload[], long length);
+
+typedef struct {
+    long             k, m;
+    rs255pfecDeliver deliver;
+    void             *context;
+    rs255pfecWindow  slot[rs255pfecWindowSlots];
+} rs255pfecDecoder;
+
+/*Lock-free single producer, single consumer packet ring*/
+typedef struct {
+    _Alignas(64) atomic_ulong head; /*written by the producer only*/
+    _Alignas(64) atomic_ulong tail; /*written by the consumer only*/
+    rs255pfecPacket packet[rs255pfecRingSize];
+} rs255pfecRing;
+
+long rs255pfecEncoderInit(rs255pfecEncoder *encoder, long k, long m);
+long rs255pfecEncode(rs255pfecEncoder *encoder, unsigned char payload[], long length, rs255pfecPacket out[]);
+long rs255pfecEncoderFlush(rs255pfecEncoder *encoder, rs255pfecPacket out[]);
+
+long rs255pfecDecoderInit(rs255pfecDecoder *decoder, long k, long m, rs255pfecDeliver deliver, void *context);
+long rs255pfecDecoderReceive(rs255pfecDecoder *decoder, rs255pfecPacket *packet);
+long rs255pfecDecoderExpire(rs255pfecDecoder *decoder, unsigned long window);
+
+void rs255pfecRingInit(rs255pfecRing *ring);
+long rs255pfecRingPush(rs255pfecRing *ring, rs255pfecPacket *packet);
+long rs255pfecRingPop(rs255pfecRing *ring, rs255pfecPacket *packet);
@@ -0,0 +1,233 @@
+//
+//  rs255tune.c
+//
+//  Startup autotuner for the gf256kernel kernels used by rs255fastEncode,
+//  the syndrome calculation and the root search in rs255fastDecode.
+//
+//  Each kernel is timed on a few pseudo-random codewords for a
+//  representative parity count of every parity range, and the fastest one
+//  is selected with rs255selectKernel. The selection can be kept in a
+//  small text file so later starts skip the measurement. The file holds a
+//  version line, a line identifying the CPU and the build, and one
+//  "operation low high kernel" line per range. A file written on another
+//  CPU or by a build with other vector code is measured over.
+//
+//  Nothing calls rs255tune by itself: until it is called the table kernel
+//  is used. Call it once at startup, before the codec threads start, so the
+//  measurement does not land on the first codewords of a stream.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gf256kernel.h"
+#include "rs255fast.h"
+#include "rs255tune.h"
+
+#define  rs255tuneVersion   2
+#define  rs255tuneIdSize    256
+#define  rs255tuneRanges    4
+#define  rs255tuneWords     3  /*codewords per measurement*/
+#define  rs255tuneTrials    5  /*measurements per kernel, the fastest one counts*/
+
+static long rs255tuneLow[rs255tuneRanges]  = {1, 9, 33, 97};
+static long rs255tuneHigh[rs255tuneRanges] = {8, 32, 96, 254};
+static long rs255tuneRep[rs255tuneRanges]  = {4, 16, 64, 128};
+static long rs255tuned = -1;
+
+static double rs255tuneNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec);
+}
+
+/*Time one operation with the kernel currently selected for parity count (or locator
+  degree) n*/
+static double rs255tuneTime(long operation, long n, unsigned char words[][256])
+{
+    long            i, j, trial;
+    double          start, t, best;
+    unsigned char   b[256], s[256], roots[256];
+
+    best = 1e30;
+    for (trial=0; trial<rs255tuneTrials; trial++) {
+        start = rs255tuneNow();
+        for (i=0; i<rs255tuneWords; i++) {
+            switch(operation) {
+                case rs255opEncode : {
+                    for (j=0; j<255; j++) b[j] = words[i][j];
+                    rs255fastEncode(b, n);
+                    break;
+                }
+                case rs255opSyndroms : {
+                    rs255fastSyndroms(words[i], s, n);
+                    break;
+                }
+                case rs255opRoots : {
+                    for (j=0; j<n; j++) b[j] = words[i][j] | 1;
+                    b[n] = 1;
+                    gf256roots(b, n, roots, rs255kernelFor(rs255opRoots, n));
+                    break;
+                }
+            }
+        }
+        t = rs255tuneNow() - start;
+        if (t < best) best = t;
+    }
+    return(best);
+}
+
+/*Identify the CPU model, the vector extensions it supports and the ones this build
+  uses, as one line without spaces at the ends*/
+static void rs255tuneIdentity(char id[], long size)
+{
+    FILE            *fp;
+    char            line[rs255tuneIdSize], model[rs255tuneIdSize], *p;
+    long            n;
+
+    strcpy(model, "unknown");
+    fp = fopen("/proc/cpuinfo", "r");
+    if (fp != NULL) {
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if (strncmp(line, "model name", 10) != 0) continue;
+            p = strchr(line, ':');
+            if (p == NULL) continue;
+            p++;
+            while (*p == ' ') p++;
+            n = strlen(p);
+            while ((n > 0) && ((p[n-1] == '\n') || (p[n-1] == ' '))) n--;
+            p[n] = 0;
+            strcpy(model, p);
+            break;
+        }
+        fclose(fp);
+    }
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    snprintf(id, size, "%s; cpu ssse3=%d avx2=%d", model,
+             __builtin_cpu_supports("ssse3") ? 1 : 0, __builtin_cpu_supports("avx2") ? 1 : 0);
+#else
+    snprintf(id, size, "%s", model);
+#endif
+    n = strlen(id);
+#if defined(__SSSE3__)
+    snprintf(id+n, size-n, "; build ssse3=1");
+#else
+    snprintf(id+n, size-n, "; build ssse3=0");
+#endif
+}
+
+/*Read a kernel selection written by rs255tuneSave. Returns 0 on success, -1 if the
+  file is missing, was written on another CPU or build, or does not hold a complete
+  selection*/
+static long rs255tuneLoad(const char *cacheFile)
+{
+    FILE            *fp;
+    long            version, operation, low, high, kernel, count;
+    long            op[rs255opCount*rs255tuneRanges], lo[rs255opCount*rs255tuneRanges];
+    long            hi[rs255opCount*rs255tuneRanges], kn[rs255opCount*rs255tuneRanges];
+    char            id[rs255tuneIdSize], line[rs255tuneIdSize+8];
+
+    fp = fopen(cacheFile, "r");
+    if (fp == NULL) return(-1);
+    count = 0;
+    if ((fgets(line, sizeof(line), fp) == NULL) || (sscanf(line, "rs255tune %ld", &version) != 1) ||
+        (version != rs255tuneVersion)) {
+        fclose(fp);
+        return(-1);
+    }
+    rs255tuneIdentity(id, sizeof(id));
+    if ((fgets(line, sizeof(line), fp) == NULL) || (strncmp(line, "id ", 3) != 0) ||
+        (strncmp(line+3, id, strlen(id)) != 0) || (line[3+strlen(id)] != '\n')) {
+        fclose(fp);
+        return(-1);
+    }
+    while ((count < rs255opCount*rs255tuneRanges) &&
+           (fscanf(fp, "%ld %ld %ld %ld", &operation, &low, &high, &kernel) == 4)) {
+        if ((operation < 0) || (operation >= rs255opCount) || (kernel < 0) || (kernel >= gf256kernelCount) ||
+            (low < 0) || (high > 255) || (low > high)) break;
+        op[count] = operation;
+        lo[count] = low;
+        hi[count] = high;
+        kn[count] = kernel;
+        count++;
+    }
+    fclose(fp);
+    if (count != rs255opCount*rs255tuneRanges) return(-1);
+    for (count=0; count<rs255opCount*rs255tuneRanges; count++) {
+        rs255selectKernel(op[count], lo[count], hi[count], kn[count]);
+    }
+    return(0);
+}
+
+static void rs255tuneSave(const char *cacheFile)
+{
+    FILE            *fp;
+    long            operation, range;
+    char            id[rs255tuneIdSize];
+
+    fp = fopen(cacheFile, "w");
+    if (fp == NULL) return;
+    rs255tuneIdentity(id, sizeof(id));
+    fprintf(fp, "rs255tune %d\n", rs255tuneVersion);
+    fprintf(fp, "id %s\n", id);
+    for (operation=0; operation<rs255opCount; operation++) {
+        for (range=0; range<rs255tuneRanges; range++) {
+            fprintf(fp, "%ld %ld %ld %ld\n", operation, rs255tuneLow[range], rs255tuneHigh[range],
+                    rs255kernelFor(operation, rs255tuneLow[range]));
+        }
+    }
+    fclose(fp);
+}
+
+/*Select the fastest kernel for every operation and parity range. The gf256kernel
+  tables must be initialized. When cacheFile is not NULL a previous selection made on
+  this CPU and build is read from it, otherwise the new one is written to it. Only the
+  first call does any work, and it is not thread safe. Returns 1 if the selection
+  came from the cache file, 0 if it was measured*/
+long rs255tune(const char *cacheFile)
+{
+    long            i, j, operation, range, kernel, best;
+    unsigned long   seed;
+    double          t, bestTime;
+    unsigned char   words[rs255tuneWords][256];
+
+    if (rs255tuned >= 0) return(rs255tuned);
+    if ((cacheFile != NULL) && (rs255tuneLoad(cacheFile) == 0)) {
+        rs255tuned = 1;
+        return(rs255tuned);
+    }
+
+    /*a local generator with a fixed seed, so the caller's rand() sequence is left
+      alone and rs255tune can run while other threads use rand()*/
+    seed = 1;
+    for (i=0; i<rs255tuneWords; i++) {
+        for (j=0; j<255; j++) {
+            seed = (seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+            words[i][j] = (unsigned char) (seed >> 16);
+        }
+    }
+    for (operation=0; operation<rs255opCount; operation++) {
+        for (range=0; range<rs255tuneRanges; range++) {
+            best = gf256kernelTable;
+            bestTime = 1e30;
+            for (kernel=0; kernel<gf256kernelCount; kernel++) {
+                rs255selectKernel(operation, rs255tuneLow[range], rs255tuneHigh[range], kernel);
+                rs255tuneTime(operation, rs255tuneRep[range], words);  /*warm up*/
+                t = rs255tuneTime(operation, rs255tuneRep[range], words);
+                if (t < bestTime) {
+                    bestTime = t;
+                    best = kernel;
+                }
+            }
+            rs255selectKernel(operation, rs255tuneLow[range], rs255tuneHigh[range], best);
+        }
+    }
+    if (cacheFile != NULL) rs255tuneSave(cacheFile);
+    rs255tuned = 0;
+    return(rs255tuned);
+}
@@ -0,0 +1,10 @@
+//
+//  rs255tune.h
+//
+//  Startup autotuner choosing the fastest gf256 kernel per operation and
+//  parity range on the running machine. Not called automatically: call it
+//  once at startup, until then rs255fastEncode/rs255fastDecode use the
+//  table kernel.
+//
+
+long rs255tune(const char *cacheFile);
@@ -7,12 +7,23 @@
 
 #include <math.h>
 #include <float.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "rs255.h"
 #include "gf256.h"
+#include "gf256kernel.h"
+#include "rs255fast.h"
+#include "rs255adapt.h"
+#include "rs255pfec.h"
+#include "rs255tune.h"
+#include "rs255perf.h"
 
 /************************************************************************
  This implementation of the famous Reed-Solomon codes provides an
@@ -139,7 +150,7 @@ void randomErrorErasureTest()
             
             errorEvent = errorsInserted+erasuresInserted;
             
-            errorsCorrected = rs255decode(y, u, z, paritySymbolCount);
+            errorsCorrected = rs255fastDecode(y, u, z, paritySymbolCount);
             
             errorsFound += rs255compare(x,z,255);
             testCount++;
@@ -172,9 +183,501 @@ void randomErrorErasureTest()
 }
 
 
-int main()
+/*Run codewords through a channel with fixed symbol error and erasure rates and let the
+ adaptive controller pick the parity count. The parity count it settles on must meet
+ the target failure probability on the true channel rates.
+ */
+static void adaptiveParityRun(double errorProbability, double erasureProbability)
+{
+    long            i,j,k,erasureCount,result;
+    unsigned char   x[256],y[256],z[256],u[256];
+    rs255adaptState state;
+    double          errorRate, erasureRate, failure, target;
+
+    target = 1e-6;
+    rs255adaptInit(&state, 128, 2, 128, target, 1);
+
+    for (i=0; i<1024; i++) {
+        k = rs255adaptParity(&state);
+        for (j=0; j<255-k; j++) x[j] = (unsigned char) rand();
+        for (j=255-k; j<255; j++) x[j] = 0;
+        rs255encode(x, k);
+
+        erasureCount = 0;
+        for (j=0; j<255; j++) {
+            y[j] = x[j];
+            u[j] = 0;
+            if (rand() < (RAND_MAX * errorProbability)) y[j] ^= (unsigned char) (1 + rand() % 255);
+            else if (rand() < (RAND_MAX * erasureProbability)) {
+                y[j] = 0;
+                u[j] = 1;
+                erasureCount++;
+            }
+        }
+        result = rs255fastDecode(y, u, z, k);
+        if ((result >= 0) && (rs255compare(x, z, 255) != 0)) result = -1;
+        rs255adaptRecord(&state, result, erasureCount, k);
+    }
+    rs255adaptEstimate(&state, &errorRate, &erasureRate);
+    failure = rs255failureProbability(errorProbability, erasureProbability * (1.0 - errorProbability),
+                                      rs255adaptParity(&state));
+    printf("adaptive parity: %ld (error rate %.4f, erasure rate %.4f, true failure %.2g) %s\n",
+           rs255adaptParity(&state), errorRate, erasureRate, failure,
+           (failure <= target) ? "ok" : "ABOVE TARGET");
+}
+
+/*A burst of failed decodes with nearly every symbol erased must not lower the
+ recommendation below the parity count that failed*/
+static void adaptiveParityBurst()
+{
+    long            i,k;
+    rs255adaptState state;
+    double          failure;
+
+    rs255adaptInit(&state, 32, 2, 128, 1e-6, 0);
+    for (i=0; i<rs255adaptWindow; i++) rs255adaptRecord(&state, -1, 250, 32);
+    k = rs255adaptRecommend(&state);
+    failure = rs255failureProbability(0.0, 0.95, 16);
+    printf("adaptive parity burst: %ld (failure at 95%% erasures %.2g) %s\n", k, failure,
+           ((k > 32) && (failure > 0.99)) ? "ok" : "TOO LOW");
+}
+
+void adaptiveParityTest()
+{
+    initGF256kernelTables();
+    adaptiveParityRun(0.01, 0.02);
+    adaptiveParityRun(0.001, 0.0);
+    adaptiveParityRun(0.0, 0.0);
+    adaptiveParityBurst();
+}
+
+
+#define  pfecTestK        16
+#define  pfecTestM        4
+#define  pfecTestPackets  4010
+
+static rs255pfecEncoder pfecEncoder;
+static rs255pfecDecoder pfecDecoder;
+static rs255pfecRing    pfecRing;
+static unsigned char    pfecDelivered[pfecTestPackets];
+static long             pfecCorrupt;
+
+/*Payload of packet number seq, so the receiver can check what it got*/
+static long pfecTestPayload(long seq, unsigned char payload[])
+{
+    long            j, length;
+
+    length = 1 + (seq * 7919) % rs255pfecMaxPayload;
+    for (j=0; j<length; j++) payload[j] = (unsigned char) (seq * 31 + j);
+    return(length);
+}
+
+static void pfecTestDeliver(void *context, unsigned long window, long index, unsigned char payload[], long length)
+{
+    long            seq;
+    unsigned char   expected[rs255pfecMaxPayload];
+
+    seq = window * pfecTestK + index;
+    if ((seq >= pfecTestPackets) || (pfecTestPayload(seq, expected) != length) ||
+        (memcmp(expected, payload, length) != 0)) {
+        pfecCorrupt++;
+        return;
+    }
+    pfecDelivered[seq] = 1;
+}
+
+static long             pfecWindowLost[pfecTestPackets/pfecTestK + 1];
+static atomic_int       pfecSending;
+
+/*Network side: encode the stream, drop packets at random and push the rest into the ring*/
+static void *pfecNetworkThread(void *arg)
+{
+    long            i,n,seq;
+    unsigned char   payload[rs255pfecMaxPayload];
+    static rs255pfecPacket out[1+pfecTestM];
+
+    for (seq=0; seq<pfecTestPackets; seq++) {
+        n = rs255pfecEncode(&pfecEncoder, payload, pfecTestPayload(seq, payload), out);
+        if ((seq == (pfecTestPackets-1)) && (n == 1)) n = 1 + rs255pfecEncoderFlush(&pfecEncoder, out+1);
+        for (i=0; i<n; i++) {
+            if (rand() < (RAND_MAX / 20)) {
+                pfecWindowLost[out[i].window]++;
+                continue;
+            }
+            while (rs255pfecRingPush(&pfecRing, &out[i]) == 0) sched_yield();
+        }
+    }
+    atomic_store(&pfecSending, 0);
+    return(NULL);
+}
+
+/*Codec side: pop packets from the ring and decode until the network side is done*/
+static void *pfecCodecThread(void *arg)
+{
+    static rs255pfecPacket in;
+
+    for (;;) {
+        if (rs255pfecRingPop(&pfecRing, &in)) rs255pfecDecoderReceive(&pfecDecoder, &in);
+        else if (atomic_load(&pfecSending) == 0) {
+            if (rs255pfecRingPop(&pfecRing, &in) == 0) break;
+            rs255pfecDecoderReceive(&pfecDecoder, &in);
+        }
+        else sched_yield();
+    }
+    return(NULL);
+}
+
+/*Loopback simulation of the packet FEC: the network thread drops packets at random
+ before they reach the ring to the codec thread. Every data packet of a window that
+ lost at most m packets must be delivered. A late packet of an expired window must
+ not be delivered.
+ */
+void packetFecTest()
+{
+    long            i,j,lost,windows,recoverable,missing,delivered,late;
+    pthread_t       network, codec;
+    unsigned char   payload[rs255pfecMaxPayload];
+    static rs255pfecPacket out[1+pfecTestM];
+
+    initGF256kernelTables();
+    rs255pfecEncoderInit(&pfecEncoder, pfecTestK, pfecTestM);
+    rs255pfecDecoderInit(&pfecDecoder, pfecTestK, pfecTestM, pfecTestDeliver, NULL);
+    rs255pfecRingInit(&pfecRing);
+    atomic_init(&pfecSending, 1);
+    pfecCorrupt = 0;
+
+    pthread_create(&codec, NULL, pfecCodecThread, NULL);
+    pthread_create(&network, NULL, pfecNetworkThread, NULL);
+    pthread_join(network, NULL);
+    pthread_join(codec, NULL);
+
+    windows = (pfecTestPackets + pfecTestK - 1) / pfecTestK;
+    lost = 0;
+    recoverable = 0;
+    missing = 0;
+    delivered = 0;
+    for (i=0; i<windows; i++) {
+        lost += pfecWindowLost[i];
+        if (pfecWindowLost[i] <= pfecTestM) recoverable++;
+        for (j=i*pfecTestK; (j<(i+1)*pfecTestK) && (j<pfecTestPackets); j++) {
+            delivered += pfecDelivered[j];
+            if ((pfecWindowLost[i] <= pfecTestM) && (pfecDelivered[j] == 0)) missing++;
+        }
+    }
+
+    /*expire window 0 after its first packet, the second one arrives too late*/
+    rs255pfecEncoderInit(&pfecEncoder, pfecTestK, pfecTestM);
+    rs255pfecDecoderInit(&pfecDecoder, pfecTestK, pfecTestM, pfecTestDeliver, NULL);
+    pfecDelivered[0] = 0;
+    pfecDelivered[1] = 0;
+    rs255pfecEncode(&pfecEncoder, payload, pfecTestPayload(0, payload), out);
+    rs255pfecDecoderReceive(&pfecDecoder, &out[0]);
+    rs255pfecDecoderExpire(&pfecDecoder, 0);
+    rs255pfecEncode(&pfecEncoder, payload, pfecTestPayload(1, payload), out);
+    late = rs255pfecDecoderReceive(&pfecDecoder, &out[0]) + pfecDelivered[1];
+
+    printf("packet fec: %ld packets, %ld lost, %ld delivered, %ld of %ld windows recoverable, "
+           "%ld missing, %ld corrupt, %ld late\n",
+           (long) pfecTestPackets, lost, delivered, recoverable, windows, missing, pfecCorrupt, late);
+}
+
+
+/*Insert 0..n/2 random errors (no erasures) and check that every pattern is corrected.
+ One and two errors are handled by the closed form fast path in rs255fastDecode, more
+ errors by the full decoder.
+ */
+void fewErrorsTest()
+{
+    long            i,j,k,e,result;
+    long            decoded[4], failed[4];
+    unsigned char   x[256],y[256],z[256],u[256];
+
+    initGF256kernelTables();
+    for (e=0; e<4; e++) {
+        decoded[e] = 0;
+        failed[e] = 0;
+    }
+    for (j=0; j<255; j++) u[j] = 0;
+
+    for (i=0; i<20000; i++) {
+        k = 2 + rand() % 31;
+        for (j=0; j<255-k; j++) x[j] = (unsigned char) rand();
+        for (j=255-k; j<255; j++) x[j] = 0;
+        rs255fastEncode(x, k);
+
+        e = rand() % 4;
+        if ((2*e) > k) e = k/2;
+        for (j=0; j<255; j++) y[j] = x[j];
+        for (j=0; j<e; j++) y[(j*255)/e + rand() % (255/e)] ^= (unsigned char) (1 + rand() % 255);
+
+        result = rs255fastDecode(y, u, z, k);
+        if ((result == e) && (rs255compare(x, z, 255) == 0)) decoded[e]++;
+        else failed[e]++;
+    }
+    for (e=0; e<4; e++) {
+        printf("%ld errors: %ld decoded, %ld failed\n", e, decoded[e], failed[e]);
+    }
+}
+
+
+/*With every gf256 kernel rs255fastEncode and rs255fastDecode must give the same
+ codewords and the same decoding results as rs255encode and rs255decode.
+ rs255decode only gets words it handles: at least one error or erasure (its Euclid
+ step reads out of bounds on zero syndromes) and at most min(k, 255-k) erasures
+ (polyMultiply writes the erasure syndrome product into 256 symbols).
+ Afterwards the autotuner picks the fastest kernel per operation.
+ */
+void kernelTest()
+{
+    long            i,j,k,e,erasures,kernel,operation,result,expected,mismatch;
+    unsigned char   x[256],x0[256],y[256],z[256],u[256],xv[256],zv[256];
+    static const char *kernelName[gf256kernelCount] = {"table", "logexp", "nibble"};
+
+    initGF256kernelTables();
+    mismatch = 0;
+    for (i=0; i<2000; i++) {
+        k = 1 + rand() % 254;
+        for (j=0; j<255-k; j++) x0[j] = (unsigned char) rand();
+        for (j=255-k; j<255; j++) x0[j] = 0;
+        erasures = 0;
+        for (j=0; j<255; j++) {
+            u[j] = ((rand() % 255) < (k/4)) && (erasures < k) && ((erasures+k) < 255);
+            erasures = erasures + u[j];
+        }
+        e = rand() % (k/2 + 2);
+        if ((e == 0) && (erasures == 0)) e = 1;
+
+        for (j=0; j<255; j++) xv[j] = x0[j];
+        rs255encode(xv, k);
+        for (j=0; j<255; j++) y[j] = xv[j] ^ (u[j] ? (unsigned char) (j+1) : 0);
+        for (j=0; j<e; j++) y[(j*97 + i) % 255] ^= (unsigned char) (j+1);
+        expected = rs255decode(y, u, zv, k);
+
+        for (kernel=0; kernel<gf256kernelCount; kernel++) {
+            for (operation=0; operation<rs255opCount; operation++) rs255selectKernel(operation, 0, 255, kernel);
+            for (j=0; j<255; j++) x[j] = x0[j];
+            rs255fastEncode(x, k);
+            result = rs255fastDecode(y, u, z, k);
+            if ((rs255compare(x, xv, 255) != 0) || (result != expected) ||
+                ((result >= 0) && (rs255compare(z, zv, 255) != 0))) mismatch++;
+        }
+    }
+    for (operation=0; operation<rs255opCount; operation++) rs255selectKernel(operation, 0, 255, gf256kernelTable);
+    printf("kernels: %ld mismatches\n", mismatch);
+
+    rs255tune(NULL);
+    for (operation=0; operation<rs255opCount; operation++) {
+        printf("operation %ld:", operation);
+        for (k=4; k<=128; k*=4) printf(" %ld=%s", k, kernelName[rs255kernelFor(operation, k)]);
+        printf("\n");
+    }
+}
+
+
+#define  perfWords   1024
+#define  perfStages  8
+
+static unsigned char perfX[perfWords][256], perfY[perfWords][256], perfU[perfWords][256];
+static unsigned char perfSyndrome[perfWords][256], perfErasureSigma[perfWords][256];
+static unsigned char perfErasureSyndrome[perfWords][256], perfOmega[perfWords][256];
+static unsigned char perfErrorSigma[perfWords][256], perfSigma[perfWords][256];
+static long          perfErasureCount[perfWords], perfErrorCount[perfWords];
+static long          perfFull[perfWords]; /*word goes through the full decoder stages*/
+
+static double perfNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec);
+}
+
+/*Run one codec stage over all codewords*/
+static void perfStage(long stage, long k)
 {
+    long            i;
+    unsigned char   ePos[256], eVal[256], z[256];
+
+    for (i=0; i<perfWords; i++) {
+        switch(stage) {
+            case 0 : {
+                rs255fastEncode(perfX[i], k);
+                break;
+            }
+            case 1 : {
+                perfErasureCount[i] = rs255erasure(perfU[i], perfErasureSigma[i]);
+                break;
+            }
+            case 2 : {
+                rs255fastSyndroms(perfY[i], perfSyndrome[i], k);
+                break;
+            }
+            case 3 : {
+                if (perfErasureCount[i] == 0) rs255fastErrors(perfSyndrome[i], ePos, eVal, k);
+                break;
+            }
+            case 4 : {
+                if (!perfFull[i]) break;
+                polyMultiply(perfErasureSigma[i], perfSyndrome[i], perfErasureSyndrome[i], perfErasureCount[i], k);
+                perfErrorCount[i] = rs255euclid(perfErasureSyndrome[i], perfOmega[i], perfErrorSigma[i], k,
+                                                perfErasureCount[i]);
+                break;
+            }
+            case 5 : {
+                if (!perfFull[i]) break;
+                polyMultiply(perfErasureSigma[i], perfErrorSigma[i], perfSigma[i], perfErasureCount[i],
+                             perfErrorCount[i]);
+                rs255fastRoots(perfSigma[i], perfOmega[i], ePos, eVal, perfErrorCount[i]+perfErasureCount[i]);
+                break;
+            }
+            case 6 : {
+                rs255fastDecode(perfY[i], perfU[i], z, k);
+                break;
+            }
+            case 7 : {
+                if (perfFull[i]) rs255decode(perfY[i], perfU[i], z, k);
+                break;
+            }
+        }
+    }
+}
+
+static const char *perfKernelName[gf256kernelCount+1] = {"tune", "table", "logexp", "nibble"};
+
+/*Parse a whole decimal number in low..high. Returns 0 if s is not one*/
+static long perfArgument(const char *s, long low, long high, long *value)
+{
+    char            *end;
+
+    errno = 0;
+    *value = strtol(s, &end, 10);
+    if ((end == s) || (*end != 0) || (errno != 0)) return(0);
+    return((*value >= low) && (*value <= high));
+}
+
+/*Benchmark mode: hardware counters and time per codeword for every codec stage.
+ The fast path and the full decoder stages (euclid, roots) are measured separately
+ for all codewords, rs255fastDecode runs only the ones it needs. The last line is
+ the untouched rs255decode for comparison. Euclid, roots and rs255decode skip words
+ with zero syndromes or more than min(k, 255-k) erasures, which the vendored code
+ does not handle. "run %" is the part of the stage the
+ counters were scheduled; below 100 the counts are scaled from that part. kernel
+ is the gf256kernel used for every operation, -1 to let rs255tune choose.
+ */
+void perfBenchmark(long k, long errors, long erasures, long kernel)
+{
+    long            i,j,p,stage,counter,available,full;
+    double          start, t;
+    rs255perfState  perf;
+    static const char *stageName[perfStages] = {
+        "encode", "erasures", "syndromes", "fast path", "euclid", "roots", "decode", "rs255decode"
+    };
+
+    initGF256kernelTables();
+    if (kernel < 0) rs255tune(NULL);
+    else {
+        for (i=0; i<rs255opCount; i++) rs255selectKernel(i, 0, 255, kernel);
+    }
+
+    for (i=0; i<perfWords; i++) {
+        for (j=0; j<255-k; j++) perfX[i][j] = (unsigned char) rand();
+        for (j=255-k; j<255; j++) perfX[i][j] = 0;
+    }
+    full = 0;
+    available = rs255perfOpen(&perf);
+    printf("parity %ld, %ld errors, %ld erasures, kernel %s, %ld codewords, %ld counters\n",
+           k, errors, erasures, perfKernelName[kernel+1], (long) perfWords, available);
+    printf("%-12s %10s", "stage", "ns");
+    for (counter=0; counter<rs255perfCounters; counter++) printf(" %14s", rs255perfName[counter]);
+    printf(" %6s\n", "run %");
+
+    for (stage=0; stage<perfStages; stage++) {
+        if (stage == 1) {
+            /*channel: errors and erasures at random positions of the encoded words*/
+            for (i=0; i<perfWords; i++) {
+                for (j=0; j<255; j++) {
+                    perfY[i][j] = perfX[i][j];
+                    perfU[i][j] = 0;
+                }
+                for (j=0; j<errors; j++) perfY[i][rand() % 255] ^= (unsigned char) (1 + rand() % 255);
+                for (j=0; j<erasures; j++) {
+                    p = rand() % 255;
+                    perfU[i][p] = 1;
+                    perfY[i][p] ^= (unsigned char) (1 + rand() % 255);
+                }
+            }
+        }
+        if (stage == 3) {
+            /*the vendored euclid reads out of bounds on zero syndromes and its products
+              hold 256 symbols, so like rs255fastDecode skip those words there*/
+            for (i=0; i<perfWords; i++) {
+                j = 0;
+                while ((j<k) && (perfSyndrome[i][j]==0)) j++;
+                perfFull[i] = (j<k) && (perfErasureCount[i] <= k) && ((perfErasureCount[i]+k) <= 255);
+                full = full + perfFull[i];
+            }
+        }
+        start = perfNow();
+        rs255perfStart(&perf);
+        perfStage(stage, k);
+        rs255perfStop(&perf);
+        t = perfNow() - start;
+
+        printf("%-12s %10.1f", stageName[stage], 1e9 * t / perfWords);
+        for (counter=0; counter<rs255perfCounters; counter++) {
+            if (!rs255perfValid(&perf, counter)) printf(" %14s", "n/a");
+            else printf(" %14.1f", (double) perf.count[counter] / perfWords);
+        }
+        if (perf.enabled == 0) printf(" %6s\n", "n/a");
+        else printf(" %6.1f\n", 100.0 * perf.running / perf.enabled);
+    }
+    printf("euclid, roots and rs255decode ran on %ld of %ld codewords\n", full, (long) perfWords);
+    rs255perfClose(&perf);
+}
+
+
+int main(int argc, char *argv[])
+{
+    long            k, errors, erasures, kernel;
+
+    if ((argc > 1) && (strcmp(argv[1], "perf") == 0)) {
+        k = 32;
+        errors = 2;
+        erasures = 0;
+        kernel = gf256kernelTable;
+        if ((argc > 2) && !perfArgument(argv[2], 1, 254, &k)) {
+            fprintf(stderr, "perf: parity must be 1..254, not %s\n", argv[2]);
+            return 1;
+        }
+        if ((argc > 3) && !perfArgument(argv[3], 0, 255, &errors)) {
+            fprintf(stderr, "perf: errors must be 0..255, not %s\n", argv[3]);
+            return 1;
+        }
+        if ((argc > 4) && !perfArgument(argv[4], 0, 255, &erasures)) {
+            fprintf(stderr, "perf: erasures must be 0..255, not %s\n", argv[4]);
+            return 1;
+        }
+        if (argc > 5) {
+            kernel = gf256kernelCount;
+            while ((kernel >= 0) && (strcmp(argv[5], perfKernelName[kernel]) != 0)) kernel--;
+            if (kernel < 0) {
+                fprintf(stderr, "perf: unknown kernel %s, use table, logexp, nibble or tune\n", argv[5]);
+                return 1;
+            }
+            kernel = kernel - 1;
+        }
+        if (argc > 6) {
+            fprintf(stderr, "usage: %s perf [parity [errors [erasures [table|logexp|nibble|tune]]]]\n", argv[0]);
+            return 1;
+        }
+        perfBenchmark(k, errors, erasures, kernel);
+        return 0;
+    }
     randomErrorErasureTest();
+    adaptiveParityTest();
+    packetFecTest();
+    fewErrorsTest();
+    kernelTest();
     return 0;
     
 }